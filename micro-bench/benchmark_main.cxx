@@ -6,12 +6,15 @@
 #include "daos.h"
 #include "daos_types.h"
 #include "interfaces.h"
+#include "kv_cache.h"
 #include "toml.h"
 #include <algorithm>
 #include <atomic>
 #include <benchmark/benchmark.h>
 #include <bits/types/time_t.h>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -21,20 +24,26 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <ratio>
 #include <stdexcept>
 #include <string>
 #include <sys/resource.h>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #define UNUSED_RANGE benchmark::CreateDenseRange(1, 1, 1)
 #define BENCHMARK_POOLING
 
-const size_t REPETITIONS_PER_TEST = 1'000;
+// Overridden from [basic] section of the configuration file
+size_t REPETITIONS_PER_TEST = 1'000;
 int KEYS_TO_GENERATE = REPETITIONS_PER_TEST;
 int VALUES_TO_GENERATE = KEYS_TO_GENERATE;
 
+const char* DEFAULT_CONFIG_PATH = "micro_benchmark_config.toml";
+
 std::string POOL_LABEL = "mkojro";
 
 int try_set_open_fd_soft_limit(unsigned long no_fd) {
@@ -71,6 +80,28 @@ error:
 	}                                                                          \
   } while (false)
 
+// Benchmark described by [[workload]] table of the configuration file
+struct Workload
+{
+  std::string name;
+  // "kv" or "array", arrays support only writes
+  std::string object = "kv";
+  // Fraction of operations that are reads, the rest are writes
+  double read_ratio = 0.0;
+  // "uniform" or "zipf"
+  std::string key_distribution = "uniform";
+  // "single", "shared_container" or "container_per_thread"
+  std::string concurrency = "single";
+  bool async = false;
+  // Operations per iteration split between all threads
+  size_t operations = REPETITIONS_PER_TEST;
+  // Set when the workload sweeps cache_capacity
+  bool cached = false;
+  // Arguments passed as state.range(0) to range(4): chunk size, events in
+  // flight, threads, cache capacity and key skew in hundredths
+  std::vector<std::vector<int64_t>> ranges;
+};
+
 class Config {
  public:
   enum {
@@ -80,11 +111,15 @@ class Config {
 	WITH_EVENTS = 1 << 2
   };
 
-  //   static void parse_config(std::string path) { instance_ = new
-  //   Config(path); }
+  static void parse_config(std::string path) {
+	delete instance_;
+	instance_ = nullptr;
+	instance_ = new Config(path);
+  }
+
   static Config* instance() {
 	if (instance_ == nullptr) {
-	  instance_ = new Config("micro_benchmark_config.toml");
+	  instance_ = new Config(DEFAULT_CONFIG_PATH);
 	}
 	return instance_;
   }
@@ -92,10 +127,15 @@ class Config {
   const toml::parse_result& get() { return configuration_file_; }
 
   std::vector<int64_t> get_range_for_variable(std::string variable) {
-	std::string range_type = get()[variable]["range_type"].value_or("log");
-	auto min = get()[variable]["min"].value_or(1);
-	auto max = get()[variable]["max"].value_or(1);
-	auto step = get()[variable]["step"].value_or(2);
+	return create_range(get()[variable]);
+  }
+
+  static std::vector<int64_t>
+  create_range(toml::node_view<const toml::node> table) {
+	std::string range_type = table["range_type"].value_or("log");
+	auto min = table["min"].value_or(1);
+	auto max = table["max"].value_or(1);
+	auto step = table["step"].value_or(2);
 	std::vector<int64_t> range;
 	if (range_type == "log") {
 	  range = benchmark::CreateRange(min, max, step);
@@ -125,6 +165,29 @@ class Config {
 	return ranges;
   }
 
+  int get_repetitions() {
+	auto basic = get()["basic"];
+	// Accept misspelled key used by older configuration files
+	return basic["repetitions"].value_or(basic["repetitons"].value_or(1));
+  }
+
+  std::vector<Workload> get_workloads() {
+	std::vector<Workload> workloads;
+	const toml::array* tables = get()["workload"].as_array();
+	if (tables == nullptr) {
+	  return workloads;
+	}
+	for (const toml::node& node : *tables) {
+	  const toml::table* table = node.as_table();
+	  if (table == nullptr) {
+		throw std::runtime_error("Every 'workload' entry has to be a table");
+	  }
+	  workloads.push_back(
+		  parse_workload(toml::node_view<const toml::node>(table)));
+	}
+	return workloads;
+  }
+
   static void close() { delete instance_; }
 
  private:
@@ -138,9 +201,153 @@ class Config {
 				"Trying to increase fd count limit");
 	bench_check(bt_init() == 0, "Register backtrace handlers");
   }
+  void configure_sizes() {
+	auto basic = get()["basic"];
+	int64_t repetitions_per_test = basic["repetitions_per_test"].value_or(
+		basic["repetitons_per_test"].value_or(
+			static_cast<int64_t>(REPETITIONS_PER_TEST)));
+	int64_t generated_keys = basic["generated_keys"].value_or(
+		static_cast<int64_t>(KEYS_TO_GENERATE));
+	int64_t generated_values = basic["generated_values"].value_or(
+		static_cast<int64_t>(VALUES_TO_GENERATE));
+	if (repetitions_per_test <= 0 || generated_keys <= 0
+		|| generated_values <= 0) {
+	  throw std::runtime_error("repetitions_per_test, generated_keys and "
+							   "generated_values have to be positive");
+	}
+	REPETITIONS_PER_TEST = repetitions_per_test;
+	KEYS_TO_GENERATE = generated_keys;
+	VALUES_TO_GENERATE = generated_values;
+  }
+
+  // Workload table can override any range, otherwise the global one is used
+  std::vector<int64_t>
+  get_workload_range(toml::node_view<const toml::node> table,
+					 std::string variable) {
+	if (table[variable].is_table()) {
+	  return create_range(table[variable]);
+	}
+	return get_range_for_variable(variable);
+  }
+
+  // Range that is used only when the workload sets it explicitly
+  std::vector<int64_t>
+  get_optional_workload_range(toml::node_view<const toml::node> table,
+							  std::string variable,
+							  std::vector<int64_t> fallback) {
+	if (!table[variable]) {
+	  return fallback;
+	}
+	if (!table[variable].is_table()) {
+	  throw std::runtime_error("'" + variable + "' has to be a range table");
+	}
+	return create_range(table[variable]);
+  }
+
+  Workload parse_workload(toml::node_view<const toml::node> table) {
+	Workload workload;
+	auto name = table["name"].value<std::string>();
+	if (!name) {
+	  throw std::runtime_error("Workload is missing 'name'");
+	}
+	workload.name = *name;
+	workload.object = table["object"].value_or(workload.object);
+	workload.read_ratio = table["read_ratio"].value_or(workload.read_ratio);
+	workload.key_distribution =
+		table["key_distribution"].value_or(workload.key_distribution);
+	workload.concurrency = table["concurrency"].value_or(workload.concurrency);
+	workload.async = table["async"].value_or(workload.async);
+	int64_t operations = table["operations"].value_or(
+		static_cast<int64_t>(workload.operations));
+	workload.cached = static_cast<bool>(table["cache_capacity"]);
+
+	if (operations <= 0) {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': operations has to be positive");
+	}
+	workload.operations = operations;
+
+	if (workload.object != "kv" && workload.object != "array") {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': bad object avaliable: 'kv', 'array'");
+	}
+	if (workload.object == "array" && workload.read_ratio > 0) {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': array object supports only writes");
+	}
+	if (workload.object == "array" && workload.cached) {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': cache is supported only for kv object");
+	}
+	if (workload.async && workload.cached) {
+	  throw std::runtime_error(
+		  "Workload '" + workload.name
+		  + "': cache serves only blocking operations, disable async");
+	}
+	if (workload.read_ratio < 0 || workload.read_ratio > 1) {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': read_ratio has to be in [0, 1]");
+	}
+	if (workload.key_distribution != "uniform"
+		&& workload.key_distribution != "zipf") {
+	  throw std::runtime_error(
+		  "Workload '" + workload.name
+		  + "': bad key_distribution avaliable: 'uniform', 'zipf'");
+	}
+	if (workload.concurrency != "single"
+		&& workload.concurrency != "shared_container"
+		&& workload.concurrency != "container_per_thread") {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': bad concurrency avaliable: 'single', "
+								 "'shared_container', 'container_per_thread'");
+	}
+
+	workload.ranges.assign(3, UNUSED_RANGE);
+	workload.ranges[0] = get_workload_range(table, "chunk_size");
+	if (workload.async) {
+	  workload.ranges[1] = get_workload_range(table, "inflight_events");
+	}
+	if (workload.concurrency != "single") {
+	  workload.ranges[2] = get_workload_range(table, "threads");
+	}
+	for (const auto& range : workload.ranges) {
+	  for (int64_t value : range) {
+		if (value <= 0) {
+		  throw std::runtime_error(
+			  "Workload '" + workload.name
+			  + "': chunk_size, inflight_events and threads have to be "
+				"positive");
+		}
+	  }
+	}
+	// Same units as the global tables, capacity of 0 disables the cache
+	try {
+	  workload.ranges.push_back(
+		  get_optional_workload_range(table, "cache_capacity", {0}));
+	  workload.ranges.push_back(
+		  workload.key_distribution == "zipf"
+			  ? get_workload_range(table, "key_skew")
+			  : std::vector<int64_t>{0});
+	} catch (const std::runtime_error& err) {
+	  throw std::runtime_error("Workload '" + workload.name
+							   + "': " + err.what());
+	}
+	for (size_t i = 3; i < workload.ranges.size(); i++) {
+	  for (int64_t value : workload.ranges[i]) {
+		if (value < 0) {
+		  throw std::runtime_error(
+			  "Workload '" + workload.name
+			  + "': cache_capacity and key_skew cannot be negative");
+		}
+	  }
+	}
+	return workload;
+  }
+
   Config(std::string path) {
 	configuration_file_ = toml::parse_file(path);
 	configure_system();
+	configure_sizes();
   }
 
   static Config* instance_;
@@ -193,6 +400,7 @@ class BenchmarkState {
   size_t get_value_size() const { return value_size_; }
 
   KeyValuePtr& get_kv_store() { return key_value_store_; }
+  ContainerPtr& get_container() { return container_; }
 
   daos_event_t* get_event() {
 	if (event_queue_) {
@@ -412,42 +620,449 @@ void do_read(std::atomic_int32_t& sent_requests, BenchmarkStatePtr& bstate) {
   delete[] buffer;
 }
 
-BENCHMARK(baseline_BenchmarkState_usage)
-	->ArgsProduct(Config::instance()->get_range(Config::NONE));
+// Draws key indexes following Zipf distribution, skew of 0 is uniform
+class ZipfKeySampler {
+ public:
+  ZipfKeySampler(size_t keys_count, double skew) : cdf_(keys_count) {
+	double sum = 0;
+	for (size_t i = 0; i < keys_count; i++) {
+	  sum += 1.0 / std::pow(i + 1, skew);
+	  cdf_[i] = sum;
+	}
+	for (auto& probability : cdf_) { probability /= sum; }
+  }
+
+  size_t next() {
+	double draw = uniform_(generator_);
+	auto it = std::lower_bound(cdf_.begin(), cdf_.end(), draw);
+	return std::min<size_t>(it - cdf_.begin(), cdf_.size() - 1);
+  }
 
-BENCHMARK(creating_events_array)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE));
+ private:
+  std::vector<double> cdf_;
+  std::mt19937_64 generator_{std::random_device{}()};
+  std::uniform_real_distribution<double> uniform_{0.0, 1.0};
+};
 
-BENCHMARK(write_event_blocking)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE));
+static void read_kv_skewed(benchmark::State& state) {
+  BenchmarkState bstate(state.range(0), state);
+  // Skew is passed in hundredths as benchmark arguments are integers
+  ZipfKeySampler sampler(bstate.get_keys_count(), state.range(2) / 100.0);
+  for (size_t i = 0; i < bstate.get_keys_count(); i++) {
+	bstate.get_kv_store()->write_raw(bstate.get_key(i), bstate.get_value(i),
+									 bstate.get_value_size());
+  }
+  std::vector<char> buffer(bstate.get_value_size());
+  // Timed the same way as read_kv_skewed_cached so both are comparable
+  uint64_t uncached_time_ns = 0;
+  for (auto _ : state) {
+	for (int i = 0; i < REPETITIONS_PER_TEST; i++) {
+	  // Key is drawn before the timer so sampling is not counted as latency
+	  const char* key = bstate.get_key(sampler.next());
+	  auto start = std::chrono::steady_clock::now();
+	  bstate.get_kv_store()->read_raw(key, buffer.data(), buffer.size());
+	  uncached_time_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+							  std::chrono::steady_clock::now() - start)
+							  .count();
+	}
+  }
+  benchmark::DoNotOptimize(buffer);
 
-BENCHMARK(creating_events_kv_async)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE
-												| Config::WITH_EVENTS));
+  uint64_t reads = state.iterations() * REPETITIONS_PER_TEST;
+  state.counters["uncached_read_ns"] =
+	  reads > 0 ? static_cast<double>(uncached_time_ns) / reads : 0;
+}
 
-BENCHMARK(creating_events_multitreaded_multiple_containers)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE
-												| Config::WITH_THREADS));
+static void read_kv_skewed_cached(benchmark::State& state) {
+  BenchmarkState bstate(state.range(0), state);
+  CachedKeyValue cached_kv(*bstate.get_kv_store(), state.range(1));
+  ZipfKeySampler sampler(bstate.get_keys_count(), state.range(2) / 100.0);
+  for (size_t i = 0; i < bstate.get_keys_count(); i++) {
+	cached_kv.write_raw(bstate.get_key(i), bstate.get_value(i),
+						bstate.get_value_size());
+  }
+  std::vector<char> buffer(bstate.get_value_size());
+  uint64_t cached_time_ns = 0;
+  uint64_t uncached_time_ns = 0;
+  for (auto _ : state) {
+	for (int i = 0; i < REPETITIONS_PER_TEST; i++) {
+	  const char* key = bstate.get_key(sampler.next());
+	  auto start = std::chrono::steady_clock::now();
+	  bool hit = cached_kv.read_raw(key, buffer.data(), buffer.size());
+	  uint64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+							 std::chrono::steady_clock::now() - start)
+							 .count();
+	  (hit ? cached_time_ns : uncached_time_ns) += elapsed;
+	}
+  }
+  benchmark::DoNotOptimize(buffer);
 
-BENCHMARK(creating_events_multitreaded_multiple_containers_async)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE
-												| Config::WITH_EVENTS
-												| Config::WITH_THREADS));
+  KeyValueCacheStats stats = cached_kv.get_cache().get_stats();
+  uint64_t lookups = stats.hits + stats.misses;
+  state.counters["cache_hits"] = stats.hits;
+  state.counters["cache_misses"] = stats.misses;
+  state.counters["cache_evictions"] = stats.evictions;
+  state.counters["cache_invalidations"] = stats.invalidations;
+  state.counters["cache_slots"] = cached_kv.get_cache().get_capacity();
+  state.counters["cache_hit_rate"] =
+	  lookups > 0 ? static_cast<double>(stats.hits) / lookups : 0;
+  state.counters["cached_read_ns"] =
+	  stats.hits > 0 ? static_cast<double>(cached_time_ns) / stats.hits : 0;
+  state.counters["uncached_read_ns"] =
+	  stats.misses > 0 ? static_cast<double>(uncached_time_ns) / stats.misses
+					   : 0;
+}
 
-BENCHMARK(creating_events_multithreaded_single_container)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE
-												| Config::WITH_EVENTS
-												| Config::WITH_THREADS));
+using ArrayStorePtr = decltype(std::declval<ContainerPtr&>()->create_array());
 
-BENCHMARK(creating_events_multithreaded_single_container_async)
-	->ArgsProduct(Config::instance()->get_range(Config::WITH_CHNUK_SIZE
-												| Config::WITH_EVENTS
-												| Config::WITH_THREADS));
+// Read buffers of asynchronous reads. Each buffer belongs to one event, an
+// event returned by get_event() is free so its buffer is no longer written.
+// Buffers have to outlive wait_events().
+struct EventBuffers
+{
+  char* get(daos_event_t* event, size_t size) {
+	std::lock_guard<std::mutex> lock(mutex);
+	std::vector<char>& buffer = buffers[event];
+	buffer.resize(size);
+	return buffer.data();
+  }
+
+  std::mutex mutex;
+  std::unordered_map<daos_event_t*, std::vector<char>> buffers;
+};
+
+// State of one thread of a workload, operations are split between workers
+struct WorkloadWorker
+{
+  WorkloadWorker(const Workload& workload, BenchmarkState& bstate,
+				 CachedKeyValue* cached_kv, ArrayStorePtr* array_store,
+				 EventBuffers& event_buffers, size_t operations,
+				 double key_skew)
+	  : bstate(bstate), cached_kv(cached_kv), array_store(array_store),
+		event_buffers(event_buffers), operations(operations),
+		sampler(bstate.get_keys_count(), key_skew),
+		is_read(workload.read_ratio), buffer(bstate.get_value_size()) {}
+
+  BenchmarkState& bstate;
+  CachedKeyValue* cached_kv;
+  ArrayStorePtr* array_store;
+  EventBuffers& event_buffers;
+  size_t operations;
+  ZipfKeySampler sampler;
+  std::mt19937_64 generator{std::random_device{}()};
+  std::bernoulli_distribution is_read;
+  // Used by blocking reads
+  std::vector<char> buffer;
+};
+
+// Lets worker threads started before the benchmark loop run one batch of
+// operations per iteration
+struct WorkloadSync
+{
+  std::mutex mutex;
+  std::condition_variable round_started;
+  std::condition_variable round_finished;
+  size_t round = 0;
+  size_t finished = 0;
+  bool stop = false;
+};
+
+void run_workload_operations(const Workload& workload, WorkloadWorker& worker) {
+  BenchmarkState& bstate = worker.bstate;
+  if (workload.object == "array") {
+	for (size_t i = 0; i < worker.operations; i++) {
+	  size_t key = worker.sampler.next();
+	  // FIXME: Casting away const
+	  (*worker.array_store)
+		  ->write_raw(key, (char*)bstate.get_value(key), bstate.get_event());
+	}
+	return;
+  }
+  for (size_t i = 0; i < worker.operations; i++) {
+	size_t key = worker.sampler.next();
+	bool read = worker.is_read(worker.generator);
+	if (read) {
+	  if (worker.cached_kv != nullptr) {
+		worker.cached_kv->read_raw(bstate.get_key(key), worker.buffer.data(),
+								   worker.buffer.size());
+		continue;
+	  }
+	  daos_event_t* event = bstate.get_event();
+	  char* buffer = event != NULL ? worker.event_buffers.get(
+										 event, bstate.get_value_size())
+								   : worker.buffer.data();
+	  bstate.get_kv_store()->read_raw(bstate.get_key(key), buffer,
+									  bstate.get_value_size(), event);
+	} else if (worker.cached_kv != nullptr) {
+	  worker.cached_kv->write_raw(bstate.get_key(key), bstate.get_value(key),
+								  bstate.get_value_size());
+	} else {
+	  bstate.get_kv_store()->write_raw(bstate.get_key(key),
+									   bstate.get_value(key),
+									   bstate.get_value_size(),
+									   bstate.get_event());
+	}
+  }
+  benchmark::DoNotOptimize(worker.buffer);
+}
+
+void run_workload_thread(const Workload& workload, WorkloadWorker& worker,
+						 WorkloadSync& sync) {
+  size_t round = 0;
+  while (true) {
+	{
+	  std::unique_lock<std::mutex> lock(sync.mutex);
+	  sync.round_started.wait(
+		  lock, [&] { return sync.stop || sync.round != round; });
+	  if (sync.stop) {
+		return;
+	  }
+	  round = sync.round;
+	}
+	run_workload_operations(workload, worker);
+	{
+	  std::lock_guard<std::mutex> lock(sync.mutex);
+	  sync.finished++;
+	}
+	sync.round_finished.notify_one();
+  }
+}
+
+static void run_workload(benchmark::State& state, const Workload& workload) {
+  size_t number_of_threads =
+	  workload.concurrency == "single" ? 1 : state.range(2);
+  int events_inflight = workload.async ? state.range(1) : -1;
+  size_t states_count =
+	  workload.concurrency == "container_per_thread" ? number_of_threads : 1;
+
+  std::vector<BenchmarkStatePtr> states;
+  std::vector<std::unique_ptr<CachedKeyValue>> caches;
+  size_t cache_capacity = state.range(3);
+  // Skew is passed in hundredths as benchmark arguments are integers
+  double key_skew = state.range(4) / 100.0;
+
+  std::vector<ArrayStorePtr> array_stores(states_count);
+  std::vector<EventBuffers> event_buffers(states_count);
+  for (size_t i = 0; i < states_count; i++) {
+	states.emplace_back(std::make_unique<BenchmarkState>(
+		state.range(0), state, events_inflight));
+	auto& bstate = states.back();
+	if (workload.read_ratio > 0) {
+	  // Keys have to exist before they are read
+	  for (size_t key = 0; key < bstate->get_keys_count(); key++) {
+		bstate->get_kv_store()->write_raw(bstate->get_key(key),
+										  bstate->get_value(key),
+										  bstate->get_value_size());
+	  }
+	}
+	if (workload.object == "array") {
+	  array_stores[i] = bstate->get_container()->create_array();
+	}
+	caches.emplace_back(cache_capacity > 0
+							? std::make_unique<CachedKeyValue>(
+								*bstate->get_kv_store(), cache_capacity)
+							: nullptr);
+  }
+
+  std::vector<WorkloadWorker> workers;
+  workers.reserve(number_of_threads);
+  for (size_t thread_n = 0; thread_n < number_of_threads; thread_n++) {
+	size_t state_n = thread_n % states_count;
+	// Remainder goes to the first threads so every iteration runs exactly
+	// the configured number of operations
+	size_t operations = workload.operations / number_of_threads
+						+ (thread_n < workload.operations % number_of_threads);
+	workers.emplace_back(workload, *states[state_n], caches[state_n].get(),
+						 &array_stores[state_n], event_buffers[state_n],
+						 operations, key_skew);
+  }
+
+  if (number_of_threads == 1) {
+	for (auto _ : state) {
+	  run_workload_operations(workload, workers[0]);
+	  states[0]->wait_events();
+	}
+  } else {
+	WorkloadSync sync;
+	std::vector<std::thread> threads;
+	for (auto& worker : workers) {
+	  threads.emplace_back(run_workload_thread, std::cref(workload),
+						   std::ref(worker), std::ref(sync));
+	}
+	for (auto _ : state) {
+	  {
+		std::lock_guard<std::mutex> lock(sync.mutex);
+		sync.finished = 0;
+		sync.round++;
+	  }
+	  sync.round_started.notify_all();
+	  {
+		std::unique_lock<std::mutex> lock(sync.mutex);
+		sync.round_finished.wait(
+			lock, [&] { return sync.finished == number_of_threads; });
+	  }
+	  for (auto& bstate : states) { bstate->wait_events(); }
+	}
+	{
+	  std::lock_guard<std::mutex> lock(sync.mutex);
+	  sync.stop = true;
+	}
+	sync.round_started.notify_all();
+	for (auto& thread : threads) { thread.join(); }
+  }
+
+  if (cache_capacity > 0) {
+	KeyValueCacheStats total = {};
+	size_t slots = 0;
+	for (auto& cache : caches) {
+	  KeyValueCacheStats stats = cache->get_cache().get_stats();
+	  total.hits += stats.hits;
+	  total.misses += stats.misses;
+	  total.evictions += stats.evictions;
+	  total.invalidations += stats.invalidations;
+	  slots += cache->get_cache().get_capacity();
+	}
+	uint64_t lookups = total.hits + total.misses;
+	state.counters["cache_hits"] = total.hits;
+	state.counters["cache_misses"] = total.misses;
+	state.counters["cache_evictions"] = total.evictions;
+	state.counters["cache_invalidations"] = total.invalidations;
+	state.counters["cache_slots"] = slots;
+	state.counters["cache_hit_rate"] =
+		lookups > 0 ? static_cast<double>(total.hits) / lookups : 0;
+  }
+}
+
+// Benchmarks are registered after the configuration file is parsed so that
+// ranges and workloads can be changed without recompiling
+void register_benchmarks(Config* config) {
+  std::vector<benchmark::internal::Benchmark*> benchmarks;
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("baseline_BenchmarkState_usage",
+								   baseline_BenchmarkState_usage)
+		  ->ArgsProduct(config->get_range(Config::NONE)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("creating_events_array",
+								   creating_events_array)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("write_event_blocking",
+								   write_event_blocking)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("creating_events_kv_async",
+								   creating_events_kv_async)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE
+										  | Config::WITH_EVENTS)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark(
+		  "creating_events_multitreaded_multiple_containers",
+		  creating_events_multitreaded_multiple_containers)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE
+										  | Config::WITH_THREADS)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark(
+		  "creating_events_multitreaded_multiple_containers_async",
+		  creating_events_multitreaded_multiple_containers_async)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE
+										  | Config::WITH_EVENTS
+										  | Config::WITH_THREADS)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark(
+		  "creating_events_multithreaded_single_container",
+		  creating_events_multithreaded_single_container)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE
+										  | Config::WITH_EVENTS
+										  | Config::WITH_THREADS)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark(
+		  "creating_events_multithreaded_single_container_async",
+		  creating_events_multithreaded_single_container_async)
+		  ->ArgsProduct(config->get_range(Config::WITH_CHNUK_SIZE
+										  | Config::WITH_EVENTS
+										  | Config::WITH_THREADS)));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("read_kv_skewed", read_kv_skewed)
+		  ->ArgsProduct({config->get_range_for_variable("chunk_size"),
+						 UNUSED_RANGE,
+						 config->get_range_for_variable("key_skew")}));
+
+  benchmarks.push_back(
+	  benchmark::RegisterBenchmark("read_kv_skewed_cached",
+								   read_kv_skewed_cached)
+		  ->ArgsProduct({config->get_range_for_variable("chunk_size"),
+						 config->get_range_for_variable("cache_capacity"),
+						 config->get_range_for_variable("key_skew")}));
+
+  for (const Workload& workload : config->get_workloads()) {
+	benchmarks.push_back(
+		benchmark::RegisterBenchmark(workload.name.c_str(),
+									 [workload](benchmark::State& state) {
+									   run_workload(state, workload);
+									 })
+			->ArgsProduct(workload.ranges));
+  }
+
+  int repetitions = config->get_repetitions();
+  if (repetitions > 1) {
+	for (auto* registered : benchmarks) {
+	  registered->Repetitions(repetitions);
+	}
+  }
+}
+
+// Removes --config=<path> or --config <path> from arguments so benchmark
+// library does not report it as unrecognized
+std::string extract_config_path(int* argc, char** argv) {
+  const std::string flag = "--config";
+  std::string path = DEFAULT_CONFIG_PATH;
+  int kept = 1;
+  for (int i = 1; i < *argc; i++) {
+	std::string argument(argv[i]);
+	if (argument.rfind(flag + "=", 0) == 0) {
+	  path = argument.substr(flag.size() + 1);
+	  continue;
+	}
+	if (argument == flag && i + 1 < *argc) {
+	  path = argv[++i];
+	  continue;
+	}
+	argv[kept++] = argv[i];
+  }
+  *argc = kept;
+  return path;
+}
 
 int main(int argc, char** argv) {
+  std::string config_path = extract_config_path(&argc, argv);
+  try {
+	Config::parse_config(config_path);
+  } catch (const toml::parse_error& err) {
+	bench_printf("Failed to parse config '%s': %s", config_path.c_str(),
+				 err.what());
+	return 1;
+  } catch (const std::runtime_error& err) {
+	bench_printf("Invalid config '%s': %s", config_path.c_str(), err.what());
+	return 1;
+  }
   benchmark::Initialize(&argc, argv);
   if (benchmark::ReportUnrecognizedArguments(argc, argv))
 	return 1;
+  try {
+	register_benchmarks(Config::instance());
+  } catch (const std::runtime_error& err) {
+	bench_printf("Invalid config '%s': %s", config_path.c_str(), err.what());
+	return 1;
+  }
   daos_init();
   benchmark::RunSpecifiedBenchmarks(
 	  Config::instance()->get()["basic"]["name_regex"].value_or("all"));
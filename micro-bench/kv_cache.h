@@ -0,0 +1,224 @@
+#ifndef MK_KV_CACHE_H
+#define MK_KV_CACHE_H
+
+#include "KeyValue.h"
+#include "daos_types.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct KeyValueCacheStats
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t invalidations;
+};
+
+// Bounded client side cache for KeyValue reads. Keys are spread over shards
+// each guarded by its own lock. Replacement uses CLOCK (second chance) so a
+// hit only sets a reference bit and can be served under a shared lock.
+// Every invalidation bumps the shard generation, a fill started before it is
+// dropped so a read racing with a write cannot cache the overwritten value.
+class KeyValueCache {
+ public:
+  KeyValueCache(size_t capacity, size_t shards_count = 16) {
+	shards_count = std::max<size_t>(1, std::min(shards_count, capacity));
+	// Remainder goes to the first shards so total slots equal capacity
+	for (size_t i = 0; i < shards_count; i++) {
+	  size_t per_shard =
+		  capacity / shards_count + (i < capacity % shards_count ? 1 : 0);
+	  shards_.emplace_back(std::make_unique<Shard>(per_shard));
+	}
+  }
+
+  // Copies cached value into buffer, returns false if key is not cached or
+  // cached value is shorter than requested size. On a miss generation is set
+  // to the value that has to be passed to insert.
+  bool lookup(const std::string& key, char* buffer, size_t size,
+			  uint64_t& generation) {
+	Shard& shard = shard_for(key);
+	{
+	  std::shared_lock<std::shared_mutex> lock(shard.mutex);
+	  generation = shard.generation;
+	  auto it = shard.index.find(key);
+	  if (it != shard.index.end()) {
+		Slot& slot = shard.slots[it->second];
+		if (slot.value.size() >= size) {
+		  std::memcpy(buffer, slot.value.data(), size);
+		  slot.referenced.store(true, std::memory_order_relaxed);
+		  hits_.fetch_add(1, std::memory_order_relaxed);
+		  return true;
+		}
+	  }
+	}
+	misses_.fetch_add(1, std::memory_order_relaxed);
+	return false;
+  }
+
+  // Fill is dropped if the shard was invalidated since the lookup
+  void insert(const std::string& key, const char* value, size_t size,
+			  uint64_t generation) {
+	Shard& shard = shard_for(key);
+	if (shard.slots.empty()) {
+	  return;
+	}
+	std::unique_lock<std::shared_mutex> lock(shard.mutex);
+	if (shard.generation != generation) {
+	  return;
+	}
+	auto it = shard.index.find(key);
+	if (it != shard.index.end()) {
+	  shard.slots[it->second].value.assign(value, value + size);
+	  return;
+	}
+	size_t victim = shard.next_victim();
+	Slot& slot = shard.slots[victim];
+	if (slot.used) {
+	  shard.index.erase(slot.key);
+	  evictions_.fetch_add(1, std::memory_order_relaxed);
+	}
+	slot.key = key;
+	slot.value.assign(value, value + size);
+	slot.used = true;
+	slot.referenced.store(false, std::memory_order_relaxed);
+	shard.index.emplace(key, victim);
+  }
+
+  void invalidate(const std::string& key) {
+	Shard& shard = shard_for(key);
+	std::unique_lock<std::shared_mutex> lock(shard.mutex);
+	// Bumped even if key is not cached, a read may be filling it right now
+	shard.generation++;
+	auto it = shard.index.find(key);
+	if (it == shard.index.end()) {
+	  return;
+	}
+	Slot& slot = shard.slots[it->second];
+	slot.used = false;
+	slot.key.clear();
+	slot.value.clear();
+	shard.index.erase(it);
+	invalidations_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  size_t get_capacity() const {
+	size_t capacity = 0;
+	for (const auto& shard : shards_) { capacity += shard->slots.size(); }
+	return capacity;
+  }
+
+  KeyValueCacheStats get_stats() const {
+	return {hits_.load(), misses_.load(), evictions_.load(),
+			invalidations_.load()};
+  }
+
+ private:
+  struct Slot
+  {
+	std::string key;
+	std::vector<char> value;
+	bool used = false;
+	std::atomic_bool referenced{false};
+  };
+
+  struct Shard
+  {
+	explicit Shard(size_t capacity) : slots(capacity) {
+	  index.reserve(capacity);
+	}
+
+	// Sweeps clock hand giving referenced slots a second chance
+	size_t next_victim() {
+	  while (true) {
+		Slot& slot = slots[hand];
+		size_t current = hand;
+		hand = (hand + 1) % slots.size();
+		if (!slot.used
+			|| !slot.referenced.exchange(false, std::memory_order_relaxed)) {
+		  return current;
+		}
+	  }
+	}
+
+	std::shared_mutex mutex;
+	std::unordered_map<std::string, size_t> index;
+	std::vector<Slot> slots;
+	size_t hand = 0;
+	uint64_t generation = 0;
+  };
+
+  Shard& shard_for(const std::string& key) {
+	return *shards_[std::hash<std::string>{}(key) % shards_.size()];
+  }
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
+  std::atomic<uint64_t> evictions_{0};
+  std::atomic<uint64_t> invalidations_{0};
+};
+
+// Read through cache in front of KeyValue object. Only blocking reads are
+// served from the cache, asynchronous ones are passed to the object because
+// the buffer is not filled until the event completes. Local writes invalidate
+// the cached entry, they have to be blocking as the entry could be refilled
+// with the old value before an asynchronous write completes.
+// KeyValue::read_raw does not report the fetched length, so a miss caches all
+// size bytes of the buffer. Use it only for keys that exist and hold values of
+// exactly the size they are read with, otherwise leftover buffer content would
+// be served to every later reader. All writes have to go through the wrapper.
+class CachedKeyValue {
+ public:
+  CachedKeyValue(KeyValue& kv, size_t capacity, size_t shards_count = 16)
+	  : kv_(kv), cache_(capacity, shards_count) {}
+
+  // Returns true when the value was served from the cache
+  bool read_raw(const char* key, char* buffer, size_t size,
+				daos_event_t* event = NULL) {
+	if (event != NULL) {
+	  kv_.read_raw(key, buffer, size, event);
+	  return false;
+	}
+	std::string cache_key(key);
+	uint64_t generation = 0;
+	if (cache_.lookup(cache_key, buffer, size, generation)) {
+	  return true;
+	}
+	kv_.read_raw(key, buffer, size);
+	cache_.insert(cache_key, buffer, size, generation);
+	return false;
+  }
+
+  void write_raw(const char* key, const char* value, size_t size,
+				 daos_event_t* event = NULL) {
+	if (event != NULL) {
+	  throw std::runtime_error(
+		  "CachedKeyValue does not support asynchronous writes");
+	}
+	// Second invalidation drops fills of reads that started before the write
+	// completed and could have fetched the old value
+	cache_.invalidate(key);
+	kv_.write_raw(key, value, size, event);
+	cache_.invalidate(key);
+  }
+
+  KeyValueCache& get_cache() { return cache_; }
+
+ private:
+  KeyValue& kv_;
+  KeyValueCache cache_;
+};
+
+#endif // MK_KV_CACHE_H